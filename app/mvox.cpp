@@ -17,6 +17,80 @@
 #include <mfem.hpp>
 #include <itkImageFileReader.h>
 
+// Tensor image with scalar type T
+template <typename T>
+using TensorImageType = itk::Image<itk::DiffusionTensor3D<T>,3>;
+
+// Read tensors from `tensors_ifile` using scalar type `T`.
+template <typename T>
+typename TensorImageType<T>::Pointer read_tensors(const char *tensors_ifile)
+{
+   using TensorImageFileReaderType = itk::ImageFileReader<TensorImageType<T>>;
+
+   // Read tensors (full 3x3 or symmetric matrix with 6 components in nrrd)
+   // NOTE: image format: http://teem.sourceforge.net/nrrd/format.html#kinds
+   // "3D-symmetric-matrix"  6  Unique components of a 3D symmetric matrix: Mxx Mxy Mxz Myy Myz Mzz
+   // "3D-matrix"            9  Components of 3D matrix:                    Mxx Mxy Mxz Myx Myy Myz Mzx Mzy Mzz
+   typename TensorImageFileReaderType::Pointer tensors_reader = TensorImageFileReaderType::New();
+   std::cout << "Reading NRRD tensors file: '" << tensors_ifile << "'... " << std::flush;
+   tensors_reader->SetFileName(tensors_ifile);
+   tensors_reader->Update();
+   std::cout << "done." << std::endl;
+   return tensors_reader->GetOutput();
+}
+
+// Assign the tensors of all voxels with mask > 0 in `tensors_image` to the
+// piecewise constant grid function `tensors_gf` on `tensors_fespace`, where
+// `DataType` is mfem::GridFunction (double) or std::vector<float> (float).
+template <typename T, typename DataType>
+void assign_tensors(const TensorImageType<T> *tensors_image,
+                    const short *masks, int num_voxels, bool symmetric,
+                    const mfem::FiniteElementSpace &tensors_fespace,
+                    DataType &tensors_gf)
+{
+   const itk::DiffusionTensor3D<T>* tensors = tensors_image->GetBufferPointer();
+
+   std::cout << "Assigning tensor values... " << std::flush;
+   int ei = 0;
+   for (int vi = 0; vi < num_voxels; vi++)
+   {
+      if (masks[vi] > 0)
+      {
+         if (symmetric)
+         {
+            tensors_gf[tensors_fespace.DofToVDof(ei, 0)] = tensors[vi](0,0); // Mxx
+            tensors_gf[tensors_fespace.DofToVDof(ei, 1)] = tensors[vi](0,1); // Mxy
+            tensors_gf[tensors_fespace.DofToVDof(ei, 2)] = tensors[vi](0,2); // Mxz
+            tensors_gf[tensors_fespace.DofToVDof(ei, 3)] = tensors[vi](1,1); // Myy
+            tensors_gf[tensors_fespace.DofToVDof(ei, 4)] = tensors[vi](1,2); // Myz
+            tensors_gf[tensors_fespace.DofToVDof(ei, 5)] = tensors[vi](2,2); // Mzz
+            // Ensure that tensor is really symmetric
+            if (tensors_gf[tensors_fespace.DofToVDof(ei, 1)] != tensors[vi](1,0) ||
+                tensors_gf[tensors_fespace.DofToVDof(ei, 2)] != tensors[vi](2,0) ||
+                tensors_gf[tensors_fespace.DofToVDof(ei, 4)] != tensors[vi](2,1))
+            {
+               MFEM_ABORT("Tensor at voxel " << vi << " is not symmetric!");
+            }
+         }
+         else
+         {
+            tensors_gf[tensors_fespace.DofToVDof(ei, 0)] = tensors[vi](0,0); // Mxx
+            tensors_gf[tensors_fespace.DofToVDof(ei, 1)] = tensors[vi](0,1); // Mxy
+            tensors_gf[tensors_fespace.DofToVDof(ei, 2)] = tensors[vi](0,2); // Mxz
+            tensors_gf[tensors_fespace.DofToVDof(ei, 3)] = tensors[vi](1,0); // Myx
+            tensors_gf[tensors_fespace.DofToVDof(ei, 4)] = tensors[vi](1,1); // Myy
+            tensors_gf[tensors_fespace.DofToVDof(ei, 5)] = tensors[vi](1,2); // Myz
+            tensors_gf[tensors_fespace.DofToVDof(ei, 6)] = tensors[vi](2,0); // Mzx
+            tensors_gf[tensors_fespace.DofToVDof(ei, 7)] = tensors[vi](2,1); // Mzy
+            tensors_gf[tensors_fespace.DofToVDof(ei, 8)] = tensors[vi](2,2); // Mzz
+         }
+         ei++;
+      }
+   }
+   MFEM_ASSERT(ei == tensors_fespace.GetNE(), "Mismatch between number of tensors and elements");
+   std::cout << "done." << std::endl;
+}
+
 int main(int argc, char *argv[])
 {
    // ----------------------------------------------------------------------
@@ -65,7 +139,14 @@ int main(int argc, char *argv[])
    const char *attributes_ifile = ""; // input attributes filename
    const char *tensors_ifile = "";    // input tensors filename
 
+   const char *tensor_precision = "double"; // tensor scalar type
+
    bool visualization = false;
+   const char *visualization_mode = "volume"; // GLVis mesh to send
+   int visualization_elements = 1000000;      // preview element budget
+
+   // Avoid excessive memory usage with large meshes in GLVis
+   const int max_visualization_elements = 5000000;
    bool symmetric = false;
    bool boxmesh = false;
 
@@ -106,6 +187,10 @@ int main(int argc, char *argv[])
                   "-sym", "--symmetric-tensors",
                   "-no-sym", "--no-symmetric-tensors",
                   "Enable or disable symmetric tensor output.");
+   args.AddOption(&tensor_precision,
+                  "-tp", "--tensor-precision",
+                  "Tensor scalar type used for reading, storing and writing: "
+                  "double or float.");
    args.AddOption(&boxmesh,
                   "-box", "--box-mesh",
                   "-no-box", "--no-box-mesh",
@@ -137,6 +222,14 @@ int main(int argc, char *argv[])
                   "-vis", "--visualization",
                   "-no-vis", "--no-visualization",
                   "Enable or disable GLVis visualization.");
+   args.AddOption(&visualization_mode,
+                  "-vm", "--visualization-mode",
+                  "GLVis visualization mode: volume (voxelized mesh), "
+                  "surface (exterior and interface surfaces only) or "
+                  "preview (coarsened voxelized mesh).");
+   args.AddOption(&visualization_elements,
+                  "-vne", "--visualization-elements",
+                  "Maximum number of elements for the preview visualization mode.");
 
    args.Parse();
 
@@ -158,6 +251,31 @@ int main(int argc, char *argv[])
       return 1;
    }
 
+   // Check option values before reading any (possibly large) image files
+   if (strcmp(tensor_precision, "double") != 0 &&
+       strcmp(tensor_precision, "float") != 0)
+   {
+      MVOX_ERROR( "Invalid tensor precision: " << tensor_precision
+                  << " (must be double or float)." );
+      return 1;
+   }
+   if (strcmp(visualization_mode, "volume") != 0 &&
+       strcmp(visualization_mode, "surface") != 0 &&
+       strcmp(visualization_mode, "preview") != 0)
+   {
+      MVOX_ERROR( "Invalid visualization mode: " << visualization_mode
+                  << " (must be volume, surface or preview)." );
+      return 1;
+   }
+   if (visualization_elements < 1 ||
+       visualization_elements > max_visualization_elements)
+   {
+      MVOX_ERROR( "Invalid number of visualization elements: "
+                  << visualization_elements << " (must be between 1 and "
+                  << max_visualization_elements << ")." );
+      return 1;
+   }
+
    args.PrintOptions(std::cout);
    std::cout << std::endl;
 
@@ -191,10 +309,6 @@ int main(int argc, char *argv[])
    // Scalar images
    using ShortImageType = itk::Image<short,3>;
    using ShortImageFileReaderType = itk::ImageFileReader<ShortImageType>;
-   // Tensor images
-   using TensorPixelType = itk::DiffusionTensor3D<double>;
-   using TensorImageType = itk::Image<TensorPixelType,3>;
-   using TensorImageFileReaderType = itk::ImageFileReader<TensorImageType>;
 
    // Read masks
    ShortImageFileReaderType::Pointer masks_reader = ShortImageFileReaderType::New();
@@ -216,12 +330,9 @@ int main(int argc, char *argv[])
    // Read scalars
    // Read vectors
 
-   // Read tensors (full 3x3 or symmetric matrix with 6 components in nrrd)
-   // NOTE: image format: http://teem.sourceforge.net/nrrd/format.html#kinds
-   // "3D-symmetric-matrix"  6  Unique components of a 3D symmetric matrix: Mxx Mxy Mxz Myy Myz Mzz
-   // "3D-matrix"            9  Components of 3D matrix:                    Mxx Mxy Mxz Myx Myy Myz Mzx Mzy Mzz
-   TensorImageFileReaderType::Pointer tensors_reader = TensorImageFileReaderType::New();
-   TensorImageType::Pointer tensors_image;
+   // Read tensors (stored as float or double depending on tensor precision)
+   TensorImageType<float>::Pointer tensors_image_float;
+   TensorImageType<double>::Pointer tensors_image_double;
    if (strcmp(tensors_ifile, "") == 0)
    {
       if (strcmp(tensors_ofile, "") != 0)
@@ -231,31 +342,23 @@ int main(int argc, char *argv[])
       }
       // else all good because no input and no output
    }
+   else if (strcmp(tensors_ofile, "") == 0)
+   {
+      MVOX_ERROR( "Tensor input exists but tensor output file not specified." );
+      return 1;
+   }
+   else if (strcmp(tensor_precision, "float") == 0)
+   {
+      tensors_image_float = read_tensors<float>(tensors_ifile);
+   }
    else
    {
-      if (strcmp(tensors_ofile, "") == 0)
-      {
-         MVOX_ERROR( "Tensor input exists but tensor output file not specified." );
-         return 1;
-      }
-      else // both input and ouput tensor files specified:
-      {
-         std::cout << "Reading NRRD tensors file: '" << tensors_ifile << "'... " << std::flush;
-         tensors_reader->SetFileName(tensors_ifile);
-         tensors_reader->Update();
-         tensors_image = tensors_reader->GetOutput();
-         std::cout << "done." << std::endl;
-      }
+      tensors_image_double = read_tensors<double>(tensors_ifile);
    }
 
    // Image data
    short* masks = masks_image->GetBufferPointer();
    short* attributes = attributes_image->GetBufferPointer();
-   TensorPixelType* tensors;
-   if (strcmp(tensors_ifile, "") != 0)
-   {
-      tensors = tensors_image->GetBufferPointer();
-   }
 
    // ----------------------------------------------------------------------
    // Get information from *masks* image only
@@ -440,51 +543,24 @@ int main(int argc, char *argv[])
       mfem::L2_FECollection tensors_fec(0, dim);
       mfem::FiniteElementSpace tensors_fespace(&vox, &tensors_fec, vdim);
 
-      // Define grid functions for tensor components
-      mfem::GridFunction tensors_gf(&tensors_fespace);
-
-      std::cout << "Assigning tensor values... " << std::flush;
-      for (int vi = 0, ei = 0; vi < num_voxels; vi++)
+      if (strcmp(tensor_precision, "float") == 0)
       {
-         if (masks[vi] > 0)
-         {
-            if (symmetric)
-            {
-               tensors_gf(tensors_fespace.DofToVDof(ei, 0)) = tensors[vi](0,0); // Mxx
-               tensors_gf(tensors_fespace.DofToVDof(ei, 1)) = tensors[vi](0,1); // Mxy
-               tensors_gf(tensors_fespace.DofToVDof(ei, 2)) = tensors[vi](0,2); // Mxz
-               tensors_gf(tensors_fespace.DofToVDof(ei, 3)) = tensors[vi](1,1); // Myy
-               tensors_gf(tensors_fespace.DofToVDof(ei, 4)) = tensors[vi](1,2); // Myz
-               tensors_gf(tensors_fespace.DofToVDof(ei, 5)) = tensors[vi](2,2); // Mzz
-               // Ensure that tensor is really symmetric
-               if (tensors_gf(tensors_fespace.DofToVDof(ei, 1)) != tensors[vi](1,0) ||
-                   tensors_gf(tensors_fespace.DofToVDof(ei, 2)) != tensors[vi](2,0) ||
-                   tensors_gf(tensors_fespace.DofToVDof(ei, 4)) != tensors[vi](2,1))
-               {
-                  MFEM_ABORT("Tensor at voxel " << vi << " is not symmetric!");
-               }
-            }
-            else
-            {
-               tensors_gf(tensors_fespace.DofToVDof(ei, 0)) = tensors[vi](0,0); // Mxx
-               tensors_gf(tensors_fespace.DofToVDof(ei, 1)) = tensors[vi](0,1); // Mxy
-               tensors_gf(tensors_fespace.DofToVDof(ei, 2)) = tensors[vi](0,2); // Mxz
-               tensors_gf(tensors_fespace.DofToVDof(ei, 3)) = tensors[vi](1,0); // Myx
-               tensors_gf(tensors_fespace.DofToVDof(ei, 4)) = tensors[vi](1,1); // Myy
-               tensors_gf(tensors_fespace.DofToVDof(ei, 5)) = tensors[vi](1,2); // Myz
-               tensors_gf(tensors_fespace.DofToVDof(ei, 6)) = tensors[vi](2,0); // Mzx
-               tensors_gf(tensors_fespace.DofToVDof(ei, 7)) = tensors[vi](2,1); // Mzy
-               tensors_gf(tensors_fespace.DofToVDof(ei, 8)) = tensors[vi](2,2); // Mzz
-            }
-            ei++;
-         }
+         // Define single precision data for tensor components
+         std::vector<float> tensors_gf(tensors_fespace.GetVSize());
+         assign_tensors(tensors_image_float.GetPointer(), masks, num_voxels,
+                        symmetric, tensors_fespace, tensors_gf);
+         std::cout << "Saving tensors to file: '" << tensors_ofile << "'... " << std::flush;
+         save_gridfunction(tensors_fespace, tensors_gf, tensors_ofile);
+      }
+      else
+      {
+         // Define grid functions for tensor components
+         mfem::GridFunction tensors_gf(&tensors_fespace);
+         assign_tensors(tensors_image_double.GetPointer(), masks, num_voxels,
+                        symmetric, tensors_fespace, tensors_gf);
+         std::cout << "Saving tensors to file: '" << tensors_ofile << "'... " << std::flush;
+         save_gridfunction(tensors_gf, tensors_ofile);
       }
-      MFEM_ASSERT(ei == vox.GetNE(), "Mismatch between number of tensors and elements");
-      std::cout << "done." << std::endl;
-
-      // Save tensors to file
-      std::cout << "Saving tensors to file: '" << tensors_ofile << "'... " << std::flush;
-      save_gridfunction(tensors_gf, tensors_ofile);
       std::cout << "done." << std::endl;
    }
 
@@ -493,21 +569,75 @@ int main(int argc, char *argv[])
 
    if (visualization)
    {
-      std::cout << "Visualizing the voxelized mesh... " << std::flush;
+      if (strcmp(visualization_mode, "volume") == 0 &&
+          ne_keep > max_visualization_elements)
+      {
+         MVOX_WARNING( "Too big to visualize volume with GLVis (using preview instead)." );
+         visualization_mode = "preview";
+      }
+
+      mfem::Mesh *vis_mesh = &vox;
+      if (strcmp(visualization_mode, "surface") == 0)
+      {
+         std::cout << "Extracting surface mesh... " << std::flush;
+         vis_mesh = make_surface_mesh(vox);
+         std::cout << "done." << std::endl;
+      }
+      else if (strcmp(visualization_mode, "preview") == 0)
+      {
+         // Block size such that there are at most the requested number of elements
+         std::cout << "Computing preview block size... " << std::flush;
+         int block = preview_block_size(boxmesh ? nullptr : masks,
+                                        nx, ny, nz, visualization_elements);
+         std::cout << "done." << std::endl;
+         std::cout << "Generating preview mesh with "
+                   << block << "x" << block << "x" << block
+                   << " voxel blocks... " << std::flush;
+         double origin[3];
+         double axes[3][3];
+         for (int i = 0; i < dim; i++)
+         {
+            origin[i] = mesh_origin[i];
+            for (int j = 0; j < dim; j++)
+            {
+               axes[j][i] = direction(i,j)*spacing[j];
+            }
+         }
+         vis_mesh = make_preview_mesh(boxmesh ? nullptr : masks,
+                                      boxmesh ? nullptr : attributes,
+                                      nx, ny, nz, block, origin, axes);
+         std::cout << "done." << std::endl;
+      }
 
-      // Avoid excessive memory usage with large meshes
-      if (ne_keep > 5e6)
+      if (vis_mesh->GetNE() == 0)
       {
-         MFEM_ABORT( "Too big to visualize with GLVis." );
+         MVOX_WARNING( "The " << visualization_mode << " mesh has no elements." );
       }
 
+      // Element attributes as piecewise constant grid function for coloring
+      mfem::L2_FECollection attributes_fec(0, vis_mesh->Dimension());
+      mfem::FiniteElementSpace attributes_fespace(vis_mesh, &attributes_fec);
+      mfem::GridFunction attributes_gf(&attributes_fespace);
+      for (int e = 0; e < vis_mesh->GetNE(); e++)
+      {
+         attributes_gf(e) = vis_mesh->GetAttribute(e);
+      }
+
+      std::cout << "Visualizing the " << visualization_mode << " mesh with "
+                << vis_mesh->GetNE() << " elements... " << std::flush;
+
       char vishost[] = "localhost";
       int  visport   = 19916;
       mfem::socketstream sock(vishost, visport);
       sock.precision(8);
-      sock << "mesh\n" << vox << std::flush;
+      sock << "solution\n" << *vis_mesh << attributes_gf << std::flush;
 
       std::cout << "done." << std::endl;
+
+      if (vis_mesh != &vox)
+      {
+         delete vis_mesh;
+      }
    }
 
    // ----------------------------------------------------------------------
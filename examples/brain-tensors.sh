@@ -6,3 +6,7 @@
 # - Zwick BF, Safdar S, Bourantas GC, Joldes GR, Hyde DE, Warfield SK, Wittek A, Miller K. Image data and computational grids for computing brain shift and solving the electrocorticography forward problem. Data Brief. 2023;48:109122, DOI: 10.1016/j.dib.2023.109122.
 mvox --input-attributes labelmap.nrrd --input-tensors cond.nrrd --output-mesh mesh.mesh.gz --output-tensors cond.gf.gz
 mvox --input-attributes labelmap.nrrd --input-tensors cond.nrrd --output-mesh brain.vtk --output-tensors cond-brain.gf.gz
+# Single precision tensors must match double precision tensors within the
+# combined float and 9 digit decimal rounding error bound (see README)
+mvox --input-attributes labelmap.nrrd --input-tensors cond.nrrd --output-tensors cond-float.gf.gz --tensor-precision float
+python3 ../scripts/compare_gridfunctions.py cond.gf.gz cond-float.gf.gz 6.6e-8 1.2e-38
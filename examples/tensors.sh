@@ -0,0 +1,11 @@
+#!/bin/bash
+# Check that single precision tensors match double precision tensors within
+# the combined float and 9 digit decimal rounding error bound (see README)
+# for symmetric and full tensor output using a small generated test image
+set -e
+python3 ../scripts/make_tensor_fixture.py test-labels.nrrd test-tensors.nrrd
+for sym in -sym -no-sym; do
+    mvox -iattr test-labels.nrrd -itensor test-tensors.nrrd -otensor test-tensors${sym}.gf $sym
+    mvox -iattr test-labels.nrrd -itensor test-tensors.nrrd -otensor test-tensors${sym}-float.gf $sym -tp float
+    python3 ../scripts/compare_gridfunctions.py test-tensors${sym}.gf test-tensors${sym}-float.gf 6.6e-8 1.2e-38
+done
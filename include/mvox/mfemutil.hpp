@@ -8,10 +8,47 @@
 * See file LICENSE for details.
 */
 
+#include <vector>
+
 #include <mfem.hpp>
 
+/// Create a quadrilateral surface mesh of the exterior boundary and the
+/// interfaces between elements with different attributes of the hexahedral
+/// `mesh`. Boundary faces are added once and interface faces once for each
+/// adjacent element, oriented outward from and with the attribute of that
+/// element. Each surface element has its own vertices (no shared edges),
+/// because the surface is not manifold where different labels meet the
+/// exterior. The caller owns the returned mesh.
+mfem::Mesh *make_surface_mesh(mfem::Mesh &mesh);
+
+/// Return a block size for make_preview_mesh such that the number of blocks
+/// with at least one voxel with mask > 0 (the number of preview elements) is
+/// at most `max_elements`. The block size is grown from an estimate until the
+/// blocks have been counted to satisfy this bound. If `masks` is NULL all
+/// voxels are included.
+int preview_block_size(const short *masks, int nx, int ny, int nz,
+                       int max_elements);
+
+/// Create a coarse hexahedral preview mesh of the `nx` x `ny` x `nz` voxel
+/// grid by aggregating blocks of `block` x `block` x `block` voxels. Each block
+/// with at least one voxel with mask > 0 is assigned the most frequent
+/// attribute of those voxels. If `masks` is NULL all voxels are included and if
+/// `attributes` is NULL all labels are 1. Grid vertex (x, y, z) is placed at
+/// `origin + x*axes[0] + y*axes[1] + z*axes[2]`. The caller owns the returned
+/// mesh.
+mfem::Mesh *make_preview_mesh(const short *masks, const short *attributes,
+                              int nx, int ny, int nz, int block,
+                              const double origin[3], const double axes[3][3]);
+
 /// Save `mesh` depending on the `filename` extension.
 void save_mesh(mfem::Mesh &mesh, const char *filename);
 
 /// Save `gridfunction` depending on the `filename` extension.
 void save_gridfunction(mfem::GridFunction &gridfunction, const char *filename);
+
+/// Save single precision grid function `data` defined on `fespace` depending
+/// on the `filename` extension, using the same layout as GridFunction::Save
+/// with the number of digits needed to round-trip a float.
+void save_gridfunction(mfem::FiniteElementSpace &fespace,
+                       const std::vector<float> &data,
+                       const char *filename);
@@ -0,0 +1,59 @@
+"""Compare the values of two MFEM grid function files.
+
+Run with: python3 scripts/compare_gridfunctions.py a.gf[.gz] b.gf[.gz] rtol [atol]
+
+Exits with a non-zero status if the files have different headers or sizes
+or if any value a of the first file and the corresponding value b of the
+second file do not satisfy |b - a| <= rtol |a| + atol (default atol = 0).
+Use atol to allow values below the smallest normal float to be flushed to zero.
+"""
+
+import gzip
+import sys
+
+
+def read_gridfunction(filename):
+    """Return the header lines and values of a grid function file."""
+    opener = gzip.open if filename.endswith(".gz") else open
+    with opener(filename, "rt") as f:
+        lines = f.read().splitlines()
+    # The header is the finite element space followed by a blank line
+    end = lines.index("")
+    values = [float(v) for line in lines[end + 1:] for v in line.split()]
+    return lines[:end], values
+
+
+def main(argv):
+    if len(argv) not in (4, 5):
+        print(__doc__)
+        return 2
+    filename_a, filename_b, rtol = argv[1], argv[2], float(argv[3])
+    atol = float(argv[4]) if len(argv) == 5 else 0.0
+
+    header_a, values_a = read_gridfunction(filename_a)
+    header_b, values_b = read_gridfunction(filename_b)
+    if header_a != header_b:
+        print(f"Headers differ: {header_a} != {header_b}")
+        return 1
+    if len(values_a) != len(values_b):
+        print(f"Sizes differ: {len(values_a)} != {len(values_b)}")
+        return 1
+
+    max_error = 0.0
+    num_failed = 0
+    for a, b in zip(values_a, values_b):
+        if a != b:
+            if abs(b - a) > rtol * abs(a) + atol:
+                num_failed += 1
+            if abs(a) > atol:
+                max_error = max(max_error, abs(b - a) / abs(a))
+    print(f"Compared {len(values_a)} values: max relative difference = {max_error:g}"
+          f" (excluding |a| <= {atol:g})")
+    if num_failed > 0:
+        print(f"{num_failed} values exceed tolerance rtol = {rtol:g}, atol = {atol:g}")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,67 @@
+"""Write a small labels and tensors NRRD image pair for testing MVox.
+
+Run with: python3 scripts/make_tensor_fixture.py labels.nrrd tensors.nrrd
+
+The labels image (short) has excluded voxels (0) and two labels (1 and 2).
+The tensors image (double, 3D-symmetric-matrix) has values that are not
+exactly representable as float, values over a wide range of magnitudes,
+zeros and values in the float subnormal range (flushed to zero as float).
+"""
+
+import struct
+import sys
+
+NX, NY, NZ = 4, 3, 2
+
+
+def write_nrrd(filename, type_name, fmt, sizes, kinds, values):
+    """Write raw little-endian `values` with the given NRRD header fields."""
+    directions = "(1,0,0) (0,1,0) (0,0,1)"
+    if len(sizes) == 4:
+        directions = "none " + directions
+    header = (
+        "NRRD0004\n"
+        f"type: {type_name}\n"
+        f"dimension: {len(sizes)}\n"
+        "space: left-posterior-superior\n"
+        f"sizes: {' '.join(str(s) for s in sizes)}\n"
+        f"space directions: {directions}\n"
+        f"kinds: {' '.join(kinds)}\n"
+        "endian: little\n"
+        "encoding: raw\n"
+        "space origin: (0,0,0)\n"
+        "\n"
+    )
+    with open(filename, "wb") as f:
+        f.write(header.encode("ascii"))
+        f.write(struct.pack(f"<{len(values)}{fmt}", *values))
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__)
+        return 2
+    labels_filename, tensors_filename = argv[1], argv[2]
+
+    num_voxels = NX * NY * NZ
+    labels = [0 if i % 5 == 0 else 1 + i % 2 for i in range(num_voxels)]
+
+    # Unique components Mxx Mxy Mxz Myy Myz Mzz of each voxel
+    special = [1e-39, -2e-40, 1.2e-38, 0.0, 1e30, -1.0 / 3.0]
+    tensors = []
+    for i in range(num_voxels):
+        if i % 4 == 1:
+            tensors += special
+        else:
+            tensors += [(i + 1) * 0.1, -(i + 1) / 7.0, 1e-5 / (i + 1),
+                        (i + 1) * 1.1e3, 0.0, 2.0 ** 0.5 * (i + 1)]
+
+    write_nrrd(labels_filename, "short", "h", [NX, NY, NZ],
+               ["domain"] * 3, labels)
+    write_nrrd(tensors_filename, "double", "d", [6, NX, NY, NZ],
+               ["3D-symmetric-matrix"] + ["domain"] * 3, tensors)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -10,18 +10,235 @@
 
 #include "mvox/mfemutil.hpp"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
 
 #include "mvox/fileutil.hpp"    // file_ext
 
 // Constants
 constexpr auto output_precision = std::numeric_limits<double>::max_digits10;
 
-void save_mesh(mfem::Mesh &mesh, const char *filename)
+mfem::Mesh *make_surface_mesh(mfem::Mesh &mesh)
+{
+   // Find the boundary faces and the faces between different attributes
+   std::vector<int> surface_faces;
+   for (int f = 0; f < mesh.GetNumFaces(); f++)
+   {
+      int e1, e2;
+      mesh.GetFaceElements(f, &e1, &e2);
+      if (e2 < 0 || mesh.GetAttribute(e1) != mesh.GetAttribute(e2))
+      {
+         surface_faces.push_back(f);
+      }
+   }
+
+   // Interface faces are added once for each adjacent element
+   int num_quads = 0;
+   for (int f : surface_faces)
+   {
+      int e1, e2;
+      mesh.GetFaceElements(f, &e1, &e2);
+      num_quads += (e2 < 0) ? 1 : 2;
+   }
+
+   // NOTE: The surface is not manifold where three or more labels meet (or two
+   // labels meet the exterior) and mfem::Mesh stores at most two elements per
+   // edge, so each quadrilateral gets its own vertices and shares no edges.
+   mfem::Mesh *surface = new mfem::Mesh(2, 4*num_quads, num_quads,
+                                        0, mesh.SpaceDimension());
+
+   mfem::Array<int> vertices;
+   int ind[4];
+   int q = 0;
+   for (int f : surface_faces)
+   {
+      int e1, e2;
+      mesh.GetFaceElements(f, &e1, &e2);
+      mesh.GetFaceVertices(f, vertices);
+      MFEM_VERIFY(vertices.Size() == 4, "Surface mesh requires a hexahedral mesh");
+      for (int j = 0; j < 4; j++)
+      {
+         surface->AddVertex(mesh.GetVertex(vertices[j]));
+      }
+      // Face vertices are oriented outward from e1
+      ind[0] = 4*q; ind[1] = 4*q + 1; ind[2] = 4*q + 2; ind[3] = 4*q + 3;
+      surface->AddQuad(ind, mesh.GetAttribute(e1));
+      q++;
+      if (e2 >= 0)
+      {
+         for (int j = 0; j < 4; j++)
+         {
+            surface->AddVertex(mesh.GetVertex(vertices[j]));
+         }
+         // Reverse the orientation so that the quadrilateral faces out of e2
+         ind[0] = 4*q; ind[1] = 4*q + 3; ind[2] = 4*q + 2; ind[3] = 4*q + 1;
+         surface->AddQuad(ind, mesh.GetAttribute(e2));
+         q++;
+      }
+   }
+   MFEM_ASSERT(q == num_quads, "Mismatch in number of surface quadrilaterals");
+
+   surface->FinalizeTopology(false);
+
+   return surface;
+}
+
+int preview_block_size(const short *masks, int nx, int ny, int nz,
+                       int max_elements)
+{
+   MFEM_VERIFY(max_elements >= 1, "Invalid number of preview elements: " << max_elements);
+
+   // Initial guess assuming that the masked voxels fill whole blocks
+   int num_masked = 0;
+   for (int v = 0; v < nx*ny*nz; v++)
+   {
+      if (!masks || masks[v] > 0) { num_masked++; }
+   }
+   int block = std::max(1, (int) std::ceil(
+                           std::cbrt((double) num_masked / max_elements)));
+
+   std::vector<char> occupied;
+   while (true)
+   {
+      // Count the blocks with at least one masked voxel
+      const int bx = (nx + block - 1) / block;
+      const int by = (ny + block - 1) / block;
+      const int bz = (nz + block - 1) / block;
+      occupied.assign(bx*by*bz, 0);
+      int num_occupied = 0;
+      for (int z = 0, v = 0; z < nz; z++)
+      {
+         for (int y = 0; y < ny; y++)
+         {
+            for (int x = 0; x < nx; x++, v++)
+            {
+               if (masks && masks[v] <= 0) { continue; }
+               char &o = occupied[x/block + (y/block + (z/block)*by)*bx];
+               if (!o) { o = 1; num_occupied++; }
+            }
+         }
+      }
+      if (num_occupied <= max_elements) { return block; }
+
+      // Grow the block size in proportion to the excess (at least by one)
+      block = std::max(block + 1, (int) std::ceil(
+                          block * std::cbrt((double) num_occupied / max_elements)));
+   }
+}
+
+mfem::Mesh *make_preview_mesh(const short *masks, const short *attributes,
+                              int nx, int ny, int nz, int block,
+                              const double origin[3], const double axes[3][3])
+{
+   MFEM_VERIFY(block >= 1, "Invalid preview block size: " << block);
+
+   // Number of blocks in x, y, z directions
+   const int bx = (nx + block - 1) / block;
+   const int by = (ny + block - 1) / block;
+   const int bz = (nz + block - 1) / block;
+
+   mfem::Mesh *preview = new mfem::Mesh(3, (bx+1)*(by+1)*(bz+1), 0);
+
+   // Set vertices at the corners of the blocks (clamped to the image box)
+   {
+      int x, y, z;
+      double coord[3];
+      for (int k = 0; k <= bz; k++)
+      {
+         z = std::min(k*block, nz);
+         for (int j = 0; j <= by; j++)
+         {
+            y = std::min(j*block, ny);
+            for (int i = 0; i <= bx; i++)
+            {
+               x = std::min(i*block, nx);
+               for (int d = 0; d < 3; d++)
+               {
+                  coord[d] = origin[d] + axes[0][d]*x + axes[1][d]*y + axes[2][d]*z;
+               }
+               preview->AddVertex(coord);
+            }
+         }
+      }
+   }
+
+   // Set elements using the most frequent label of the masked voxels in each block
+   {
+      // Label counts of the current block (only a few labels per block)
+      std::vector<std::pair<int,int>> counts;
+      int ind[8];
+#define BVTX(XC, YC, ZC) ((XC)+((YC)+(ZC)*(by+1))*(bx+1))
+      for (int k = 0; k < bz; k++)
+      {
+         for (int j = 0; j < by; j++)
+         {
+            for (int i = 0; i < bx; i++)
+            {
+               counts.clear();
+               for (int z = k*block; z < std::min((k+1)*block, nz); z++)
+               {
+                  for (int y = j*block; y < std::min((j+1)*block, ny); y++)
+                  {
+                     for (int x = i*block; x < std::min((i+1)*block, nx); x++)
+                     {
+                        const int v = x + (y + z*ny)*nx;
+                        if (masks && masks[v] <= 0) { continue; }
+                        int label = attributes ? attributes[v] : 1;
+                        // Same highlighting of invalid voxels as the voxelized mesh
+                        if (label < 1) { label = SHRT_MIN - 1; }
+                        auto it = counts.begin();
+                        while (it != counts.end() && it->first != label) { ++it; }
+                        if (it == counts.end())
+                        {
+                           counts.emplace_back(label, 1);
+                        }
+                        else
+                        {
+                           it->second++;
+                        }
+                     }
+                  }
+               }
+               // Exclude blocks without any masked voxels
+               if (counts.empty()) { continue; }
+               auto best = counts.begin();
+               for (auto it = counts.begin(); it != counts.end(); ++it)
+               {
+                  if (it->second > best->second) { best = it; }
+               }
+
+               ind[0] = BVTX(i  , j  , k  );
+               ind[1] = BVTX(i+1, j  , k  );
+               ind[2] = BVTX(i+1, j+1, k  );
+               ind[3] = BVTX(i  , j+1, k  );
+               ind[4] = BVTX(i  , j  , k+1);
+               ind[5] = BVTX(i+1, j  , k+1);
+               ind[6] = BVTX(i+1, j+1, k+1);
+               ind[7] = BVTX(i  , j+1, k+1);
+               preview->AddHex(ind, best->first);
+            }
+         }
+      }
+#undef BVTX
+   }
+
+   preview->FinalizeTopology();
+   preview->Finalize();
+   preview->RemoveUnusedVertices();
+
+   return preview;
+}
+
+// Create output file stream for `filename` (compressed if extension is gz)
+static std::ostream *open_output_stream(const char *filename, int precision)
 {
-   // Create ouput file stream
    std::ostream *ofs;
-   if (strcmp(file_ext(filename), "gz") == 0) // compressed MFEM mesh
+   if (strcmp(file_ext(filename), "gz") == 0) // compressed MFEM file
    {
 #ifdef MFEM_USE_ZLIB
       // See https://github.com/mfem/mfem/pull/638/files
@@ -34,7 +251,18 @@ void save_mesh(mfem::Mesh &mesh, const char *filename)
    {
       ofs = new std::ofstream (filename, std::ofstream::out);
    }
-   ofs->precision(output_precision);
+   if (!ofs->good())
+   {
+      delete ofs;
+      MFEM_ABORT( "Cannot open output file: " << filename );
+   }
+   ofs->precision(precision);
+   return ofs;
+}
+
+void save_mesh(mfem::Mesh &mesh, const char *filename)
+{
+   std::ostream *ofs = open_output_stream(filename, output_precision);
 
    // Write the mesh to output file stream
    if (strcmp(file_ext(filename), "vtk") == 0)
@@ -65,25 +293,38 @@ void save_mesh(mfem::Mesh &mesh, const char *filename)
 
 void save_gridfunction(mfem::GridFunction &gridfunction, const char *filename)
 {
-   // Create ouput file stream
-   std::ostream *ofs;
-   if (strcmp(file_ext(filename), "gz") == 0) // compressed MFEM mesh
-   {
-#ifdef MFEM_USE_ZLIB
-      // See https://github.com/mfem/mfem/pull/638/files
-      ofs = new mfem::ofgzstream(filename, "zwb9");
-#else
-      MFEM_ABORT( "Cannot compress file because MFEM was built without ZLIB" );
-#endif
-   }
-   else
-   {
-      ofs = new std::ofstream (filename, std::ofstream::out);
-   }
-   ofs->precision(output_precision);
+   std::ostream *ofs = open_output_stream(filename, output_precision);
 
    // Write the gridfunction to output file stream
    gridfunction.Save(*ofs);
 
    delete ofs;
 }
+
+void save_gridfunction(mfem::FiniteElementSpace &fespace,
+                       const std::vector<float> &data,
+                       const char *filename)
+{
+   const int size = static_cast<int>(data.size());
+   MFEM_VERIFY(size == fespace.GetVSize(),
+               "Mismatch between grid function data and finite element space");
+
+   std::ostream *ofs =
+      open_output_stream(filename, std::numeric_limits<float>::max_digits10);
+
+   // Write the gridfunction to output file stream using the same layout as
+   // mfem::GridFunction::Save (which only supports double data)
+   fespace.Save(*ofs);
+   *ofs << '\n';
+   const int width = (fespace.GetOrdering() == mfem::Ordering::byNODES) ?
+                     1 : fespace.GetVDim();
+   for (int i = 0; i < size; i++)
+   {
+      // Flush subnormals to zero like mfem::Vector::Print
+      const float value = (std::fpclassify(data[i]) == FP_SUBNORMAL) ? 0.0f : data[i];
+      *ofs << value << ((i+1) % width == 0 ? '\n' : ' ');
+   }
+   ofs->flush();
+
+   delete ofs;
+}